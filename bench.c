@@ -0,0 +1,536 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+
+#define TOO_MANY_COLOURS_IMPLEMENTATION
+#include "too_many_colours.h"
+
+#define RGB8_COUNT (1 << 24)
+#define DEFAULT_RANDOM_COUNT (1 << 24)
+
+/* below one rgb8 step of chroma the hue is ill-conditioned and barely changes the colour */
+#define HUE_MIN_CHROMA (1.0 / 255.0)
+
+/* number of distinct edge case descriptions in check_edge_cases() */
+#define MAX_EDGE_CASES 32
+
+/* the RGB, HSV and HSL macros get in the way of plain function pointer declarations */
+typedef RGB HSVToRGB(HSV colour);
+typedef RGB HSLToRGB(HSL colour);
+typedef HSV RGBToHSV(RGB colour);
+typedef HSL RGBToHSL(RGB colour);
+typedef HSL HSVToHSL(HSV colour);
+typedef HSV HSLToHSV(HSL colour);
+
+typedef struct {
+	const char* name;
+	double tolerance;           /* max difference to the reference for [0..1] components */
+	double hue_tolerance;       /* max difference to the reference for hue, in degrees   */
+	double roundtrip_tolerance; /* max |rgb - x_to_rgb(rgb_to_x(rgb))|                    */
+	HSVToRGB* hsv_to_rgb;
+	HSLToRGB* hsl_to_rgb;
+	RGBToHSV* rgb_to_hsv;
+	RGBToHSL* rgb_to_hsl;
+	HSVToHSL* hsv_to_hsl;
+	HSLToHSV* hsl_to_hsv;
+} Implementation;
+
+/*
+ * verbatim copy of the scalar functions from too_many_colours.h, frozen here
+ * so changes to the header are checked against the behaviour they replace,
+ * don't change these
+ */
+double reference_wrap(double min, double max, double value) {
+	double delta = max - min;
+	if (value < min) return value + ceil((min - value)/delta)*delta;
+	if (value > max) return value - ceil((value - max)/delta)*delta;
+	return value;
+}
+
+double reference_clip(double min, double max, double value) {
+	if (value < min) return min;
+	if (value > max) return max;
+	return value;
+}
+
+void reference_clamp_rgb(RGB* colour) {
+	colour->r = reference_clip(0.0, 1.0, colour->r);
+	colour->g = reference_clip(0.0, 1.0, colour->g);
+	colour->b = reference_clip(0.0, 1.0, colour->b);
+}
+
+void reference_clamp_hsv(HSV* colour) {
+	colour->h = reference_wrap(0.0, 360.0, colour->h);
+	colour->s = reference_clip(0.0, 1.0, colour->s);
+	colour->v = reference_clip(0.0, 1.0, colour->v);
+}
+
+void reference_clamp_hsl(HSL* colour) {
+	colour->h = reference_wrap(0.0, 360.0, colour->h);
+	colour->s = reference_clip(0.0, 1.0, colour->s);
+	colour->l = reference_clip(0.0, 1.0, colour->l);
+}
+
+RGB reference_hsv_to_rgb(HSV colour) {
+	reference_clamp_hsv(&colour);
+
+	double c = colour.v * colour.s;
+	double x = c * (60.0 - fabs(reference_wrap(0.0, 120.0, colour.h) - 60.0)) / 60.0;
+
+	double r, g, b;
+	if (colour.h < 60.0)       { r = c; g = x; b = 0; }
+	else if (colour.h < 120.0) { r = x; g = c; b = 0; }
+	else if (colour.h < 180.0) { r = 0; g = c; b = x; }
+	else if (colour.h < 240.0) { r = 0; g = x; b = c; }
+	else if (colour.h < 300.0) { r = x; g = 0; b = c; }
+	else                       { r = c; g = 0; b = x; }
+
+	double m = colour.v - c;
+	RGB result = RGB(r+m, g+m, b+m);
+	reference_clamp_rgb(&result);
+	return result;
+}
+
+RGB reference_hsl_to_rgb(HSL colour) {
+	reference_clamp_hsl(&colour);
+
+	double c = (1.0 - fabs(colour.l*2.0 - 1.0)) * colour.s;
+	double x = c * (60.0 - fabs(reference_wrap(0.0, 120.0, colour.h) - 60.0)) / 60.0;
+
+	double r, g, b;
+	if (colour.h < 60.0)       { r = c; g = x; b = 0; }
+	else if (colour.h < 120.0) { r = x; g = c; b = 0; }
+	else if (colour.h < 180.0) { r = 0; g = c; b = x; }
+	else if (colour.h < 240.0) { r = 0; g = x; b = c; }
+	else if (colour.h < 300.0) { r = x; g = 0; b = c; }
+	else                       { r = c; g = 0; b = x; }
+
+	double m = colour.l - c/2.0;
+	RGB result = RGB(r+m, g+m, b+m);
+	reference_clamp_rgb(&result);
+	return result;
+}
+
+HSV reference_hsl_to_hsv(HSL colour) {
+	HSV result;
+	result.h = colour.h;
+	result.v = colour.l + colour.s * MIN(colour.l, 1.0 - colour.l);
+	if (result.v == 0.0) result.s = 0.0;
+	else result.s = 2.0 * (1.0 - colour.l / result.v);
+
+	reference_clamp_hsv(&result);
+	return result;
+}
+
+HSV reference_rgb_to_hsv(RGB colour) {
+	reference_clamp_rgb(&colour);
+
+	double max = MAX(MAX(colour.r, colour.g), colour.b);
+	double min = MIN(MIN(colour.r, colour.g), colour.b);
+
+	HSV result;
+	result.v = max;
+	double c = max - min;
+
+	if (c == 0.0) result.h = 0;
+	else if (max == colour.r) result.h = 60 * reference_wrap(0.0, 6.0, (colour.g - colour.b)/c + 0.0);
+	else if (max == colour.g) result.h = 60 * reference_wrap(0.0, 6.0, (colour.b - colour.r)/c + 2.0);
+	else if (max == colour.b) result.h = 60 * reference_wrap(0.0, 6.0, (colour.r - colour.g)/c + 4.0);
+
+	result.s = 0.0;
+	if (result.v != 0.0) result.s = c / result.v;
+
+	reference_clamp_hsv(&result);
+	return result;
+}
+
+HSL reference_rgb_to_hsl(RGB colour) {
+	reference_clamp_rgb(&colour);
+
+	double max = MAX(MAX(colour.r, colour.g), colour.b);
+	double min = MIN(MIN(colour.r, colour.g), colour.b);
+
+	HSL result;
+	result.l = (max + min) / 2.0;
+	double c = max - min;
+
+	if (c == 0.0) result.h = 0;
+	else if (max == colour.r) result.h = 60 * reference_wrap(0.0, 6.0, (colour.g - colour.b)/c + 0.0);
+	else if (max == colour.g) result.h = 60 * reference_wrap(0.0, 6.0, (colour.b - colour.r)/c + 2.0);
+	else if (max == colour.b) result.h = 60 * reference_wrap(0.0, 6.0, (colour.r - colour.g)/c + 4.0);
+
+	if (result.l == 0.0 || result.l == 1.0) result.s = 0.0;
+	else result.s = (max - result.l) / MIN(result.l, 1.0 - result.l);
+
+	reference_clamp_hsl(&result);
+	return result;
+}
+
+HSL reference_hsv_to_hsl(HSV colour) {
+	HSL result;
+	result.h = colour.h;
+	result.l = colour.v * (1 - colour.s / 2.0);
+	if (result.l == 0.0 || result.l == 1.0) result.s = 0.0;
+	else result.s = (colour.v - result.l) / MIN(result.l, 1.0 - result.l);
+
+	reference_clamp_hsl(&result);
+	return result;
+}
+
+/*
+ * the functions from too_many_colours.h and any faster implementation get
+ * added here so they're checked against the reference and timed next to it
+ */
+const Implementation implementations[] = {
+	{ "reference", 0.0, 0.0, 1e-12, reference_hsv_to_rgb, reference_hsl_to_rgb, reference_rgb_to_hsv, reference_rgb_to_hsl, reference_hsv_to_hsl, reference_hsl_to_hsv },
+	{ "header", 1e-12, 1e-9, 1e-12, hsv_to_rgb, hsl_to_rgb, rgb_to_hsv, rgb_to_hsl, hsv_to_hsl, hsl_to_hsv },
+};
+
+#define IMPLEMENTATION_COUNT (sizeof(implementations) / sizeof(implementations[0]))
+
+typedef enum {
+	FUNCTION_HSV_TO_RGB,
+	FUNCTION_HSL_TO_RGB,
+	FUNCTION_RGB_TO_HSV,
+	FUNCTION_RGB_TO_HSL,
+	FUNCTION_HSV_TO_HSL,
+	FUNCTION_HSL_TO_HSV,
+	FUNCTION_COUNT,
+} Function;
+
+const char* function_names[FUNCTION_COUNT] = {
+	"hsv_to_rgb", "hsl_to_rgb", "rgb_to_hsv", "rgb_to_hsl", "hsv_to_hsl", "hsl_to_hsv",
+};
+
+typedef struct {
+	double max_error;              /* max difference to the reference, [0..1] components */
+	double max_hue_error;          /* max difference to the reference, hue in degrees    */
+	double max_roundtrip_error;
+	unsigned long failures;        /* comparisons over the tolerances                    */
+	unsigned long roundtrip_failures;
+	unsigned long rgb8_mismatches; /* rgb8 inputs that don't survive a round trip        */
+	unsigned long edge_failures;
+	int reported[FUNCTION_COUNT];  /* only the first failing input of each is printed    */
+	int reported_roundtrip;
+	int reported_rgb8;
+	const char* reported_edge_cases[MAX_EDGE_CASES];
+	int reported_edge_case_count;
+} Errors;
+
+uint64_t random_state = 0x9E3779B97F4A7C15ull;
+
+double random_double(double min, double max) {
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 7;
+	random_state ^= random_state << 17;
+	return min + (max - min) * (double)(random_state >> 11) / (double)(1ull << 53);
+}
+
+double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+RGB rgb8(uint32_t i) {
+	return RGB((double)((i >> 16) & 0xFF) / 255.0, (double)((i >> 8) & 0xFF) / 255.0, (double)(i & 0xFF) / 255.0);
+}
+
+uint32_t to_rgb8(RGB colour) {
+	return ((uint32_t)round(255.0 * colour.r) << 16) | ((uint32_t)round(255.0 * colour.g) << 8) | (uint32_t)round(255.0 * colour.b);
+}
+
+double hue_distance(double a, double b) {
+	double d = fabs(reference_wrap(0.0, 360.0, a) - reference_wrap(0.0, 360.0, b));
+	return MIN(d, 360.0 - d);
+}
+
+double rgb_distance(RGB a, RGB b) {
+	return MAX(MAX(fabs(a.r - b.r), fabs(a.g - b.g)), fabs(a.b - b.b));
+}
+
+double hsv_chroma(HSV colour) {
+	return colour.s * colour.v;
+}
+
+double hsl_chroma(HSL colour) {
+	return (1.0 - fabs(colour.l*2.0 - 1.0)) * colour.s;
+}
+
+void report(Errors* errors, const char* name, Function function, const double in[3], const double out[3], const double ref[3]) {
+	errors->failures += 1;
+	if (errors->reported[function]) return;
+	errors->reported[function] = 1;
+	fprintf(stderr, "%s: %s(%.17g, %.17g, %.17g) = {%.17g, %.17g, %.17g} vs reference {%.17g, %.17g, %.17g}\n",
+	        name, function_names[function], in[0], in[1], in[2], out[0], out[1], out[2], ref[0], ref[1], ref[2]);
+}
+
+void compare_rgb(const Implementation* impl, Errors* errors, Function function, const double in[3], RGB out, RGB ref) {
+	double error = rgb_distance(out, ref);
+	errors->max_error = MAX(errors->max_error, error);
+	if (!(error <= impl->tolerance))
+		report(errors, impl->name, function, in, (double[3]){ out.r, out.g, out.b }, (double[3]){ ref.r, ref.g, ref.b });
+}
+
+/* hue is only compared when the reference colour has enough chroma for it to matter */
+void compare_hsv(const Implementation* impl, Errors* errors, Function function, const double in[3], HSV out, HSV ref) {
+	double error = MAX(fabs(out.s - ref.s), fabs(out.v - ref.v));
+	double hue_error = hsv_chroma(ref) >= HUE_MIN_CHROMA ? hue_distance(out.h, ref.h) : 0.0;
+	errors->max_error = MAX(errors->max_error, error);
+	errors->max_hue_error = MAX(errors->max_hue_error, hue_error);
+	if (!(error <= impl->tolerance && hue_error <= impl->hue_tolerance))
+		report(errors, impl->name, function, in, (double[3]){ out.h, out.s, out.v }, (double[3]){ ref.h, ref.s, ref.v });
+}
+
+void compare_hsl(const Implementation* impl, Errors* errors, Function function, const double in[3], HSL out, HSL ref) {
+	double error = MAX(fabs(out.s - ref.s), fabs(out.l - ref.l));
+	double hue_error = hsl_chroma(ref) >= HUE_MIN_CHROMA ? hue_distance(out.h, ref.h) : 0.0;
+	errors->max_error = MAX(errors->max_error, error);
+	errors->max_hue_error = MAX(errors->max_hue_error, hue_error);
+	if (!(error <= impl->tolerance && hue_error <= impl->hue_tolerance))
+		report(errors, impl->name, function, in, (double[3]){ out.h, out.s, out.l }, (double[3]){ ref.h, ref.s, ref.l });
+}
+
+/* each check runs the implementation and the reference on the same input and returns the implementation's result */
+RGB check_hsv_to_rgb(const Implementation* impl, Errors* errors, HSV in) {
+	RGB out = impl->hsv_to_rgb(in);
+	compare_rgb(impl, errors, FUNCTION_HSV_TO_RGB, (double[3]){ in.h, in.s, in.v }, out, reference_hsv_to_rgb(in));
+	return out;
+}
+
+RGB check_hsl_to_rgb(const Implementation* impl, Errors* errors, HSL in) {
+	RGB out = impl->hsl_to_rgb(in);
+	compare_rgb(impl, errors, FUNCTION_HSL_TO_RGB, (double[3]){ in.h, in.s, in.l }, out, reference_hsl_to_rgb(in));
+	return out;
+}
+
+HSV check_rgb_to_hsv(const Implementation* impl, Errors* errors, RGB in) {
+	HSV out = impl->rgb_to_hsv(in);
+	compare_hsv(impl, errors, FUNCTION_RGB_TO_HSV, (double[3]){ in.r, in.g, in.b }, out, reference_rgb_to_hsv(in));
+	return out;
+}
+
+HSL check_rgb_to_hsl(const Implementation* impl, Errors* errors, RGB in) {
+	HSL out = impl->rgb_to_hsl(in);
+	compare_hsl(impl, errors, FUNCTION_RGB_TO_HSL, (double[3]){ in.r, in.g, in.b }, out, reference_rgb_to_hsl(in));
+	return out;
+}
+
+HSL check_hsv_to_hsl(const Implementation* impl, Errors* errors, HSV in) {
+	HSL out = impl->hsv_to_hsl(in);
+	compare_hsl(impl, errors, FUNCTION_HSV_TO_HSL, (double[3]){ in.h, in.s, in.v }, out, reference_hsv_to_hsl(in));
+	return out;
+}
+
+HSV check_hsl_to_hsv(const Implementation* impl, Errors* errors, HSL in) {
+	HSV out = impl->hsl_to_hsv(in);
+	compare_hsv(impl, errors, FUNCTION_HSL_TO_HSV, (double[3]){ in.h, in.s, in.l }, out, reference_hsl_to_hsv(in));
+	return out;
+}
+
+void check_roundtrip(const Implementation* impl, Errors* errors, const char* path, RGB in, RGB out) {
+	double error = rgb_distance(in, out);
+	errors->max_roundtrip_error = MAX(errors->max_roundtrip_error, error);
+	if (error <= impl->roundtrip_tolerance) return;
+
+	errors->roundtrip_failures += 1;
+	if (errors->reported_roundtrip) return;
+	errors->reported_roundtrip = 1;
+	fprintf(stderr, "%s: round trip %s (%.17g, %.17g, %.17g) = {%.17g, %.17g, %.17g}\n",
+	        impl->name, path, in.r, in.g, in.b, out.r, out.g, out.b);
+}
+
+void check_rgb8_roundtrip(const Implementation* impl, Errors* errors, const char* path, uint32_t in, RGB out) {
+	if (to_rgb8(out) == in) return;
+
+	errors->rgb8_mismatches += 1;
+	if (errors->reported_rgb8) return;
+	errors->reported_rgb8 = 1;
+	fprintf(stderr, "%s: rgb8 round trip %s #%06X = #%06X\n", impl->name, path, in, to_rgb8(out));
+}
+
+void check_rgb8(const Implementation* impl, Errors* errors) {
+	for (uint32_t i = 0; i < RGB8_COUNT; i++) {
+		RGB rgb = rgb8(i);
+
+		HSV hsv = check_rgb_to_hsv(impl, errors, rgb);
+		HSL hsl = check_rgb_to_hsl(impl, errors, rgb);
+		RGB from_hsv = check_hsv_to_rgb(impl, errors, hsv);
+		RGB from_hsl = check_hsl_to_rgb(impl, errors, hsl);
+		RGB from_hsv_hsl = impl->hsv_to_rgb(check_hsl_to_hsv(impl, errors, check_hsv_to_hsl(impl, errors, hsv)));
+
+		check_roundtrip(impl, errors, "rgb -> hsv -> rgb", rgb, from_hsv);
+		check_roundtrip(impl, errors, "rgb -> hsl -> rgb", rgb, from_hsl);
+		check_roundtrip(impl, errors, "rgb -> hsv -> hsl -> hsv -> rgb", rgb, from_hsv_hsl);
+		check_rgb8_roundtrip(impl, errors, "rgb -> hsv -> rgb", i, from_hsv);
+		check_rgb8_roundtrip(impl, errors, "rgb -> hsl -> rgb", i, from_hsl);
+		check_rgb8_roundtrip(impl, errors, "rgb -> hsv -> hsl -> hsv -> rgb", i, from_hsv_hsl);
+	}
+}
+
+/* out of range values on purpose, so wrap() and clip() are exercised too */
+void check_random(const Implementation* impl, Errors* errors, long count) {
+	random_state = 0x9E3779B97F4A7C15ull;
+	for (long i = 0; i < count; i++) {
+		HSV hsv = HSV(random_double(-720.0, 1080.0), random_double(-0.25, 1.25), random_double(-0.25, 1.25));
+		HSL hsl = HSL(random_double(-720.0, 1080.0), random_double(-0.25, 1.25), random_double(-0.25, 1.25));
+		RGB rgb = RGB(random_double(-0.25, 1.25), random_double(-0.25, 1.25), random_double(-0.25, 1.25));
+
+		check_hsv_to_rgb(impl, errors, hsv);
+		check_hsl_to_rgb(impl, errors, hsl);
+		check_rgb_to_hsv(impl, errors, rgb);
+		check_rgb_to_hsl(impl, errors, rgb);
+		check_hsv_to_hsl(impl, errors, hsv);
+		check_hsl_to_hsv(impl, errors, hsl);
+
+		reference_clamp_rgb(&rgb);
+		check_roundtrip(impl, errors, "rgb -> hsv -> rgb", rgb, impl->hsv_to_rgb(impl->rgb_to_hsv(rgb)));
+		check_roundtrip(impl, errors, "rgb -> hsl -> rgb", rgb, impl->hsl_to_rgb(impl->rgb_to_hsl(rgb)));
+	}
+}
+
+/* like the other checks only the first failing input of each edge case is printed */
+void edge_case(const Implementation* impl, Errors* errors, int ok, const char* description, const double in[3]) {
+	if (ok) return;
+	errors->edge_failures += 1;
+
+	for (int i = 0; i < errors->reported_edge_case_count; i++)
+		if (strcmp(errors->reported_edge_cases[i], description) == 0) return;
+	if (errors->reported_edge_case_count < MAX_EDGE_CASES)
+		errors->reported_edge_cases[errors->reported_edge_case_count++] = description;
+
+	fprintf(stderr, "%s: edge case failed: %s for (%.17g, %.17g, %.17g)\n", impl->name, description, in[0], in[1], in[2]);
+}
+
+void check_edge_cases(const Implementation* impl, Errors* errors) {
+	const double values[] = { 0.0, 0.25, 0.5, 1.0 / 3.0, 0.75, 1.0 };
+	const int count = sizeof(values) / sizeof(values[0]);
+	double t = impl->tolerance;
+	double ht = impl->hue_tolerance;
+
+	HSL black = impl->rgb_to_hsl(RGB(0.0, 0.0, 0.0));
+	HSL white = impl->rgb_to_hsl(RGB(1.0, 1.0, 1.0));
+	edge_case(impl, errors, fabs(black.s) <= t && fabs(black.l) <= t, "hsl black has zero saturation", (double[3]){ 0.0, 0.0, 0.0 });
+	edge_case(impl, errors, fabs(white.s) <= t && fabs(white.l - 1.0) <= t, "hsl white has zero saturation", (double[3]){ 1.0, 1.0, 1.0 });
+
+	for (int i = 0; i < count; i++) {
+		for (int j = 0; j < count; j++) {
+			double s = values[i];
+			double x = values[j];
+			double h = values[j] * 360.0;
+
+			/* wrap() keeps 360 as is, which has to give the same colour as 0 */
+			edge_case(impl, errors, rgb_distance(impl->hsv_to_rgb(HSV(360.0, s, x)), impl->hsv_to_rgb(HSV(0.0, s, x))) <= t, "hsv hue 360 == hue 0", (double[3]){ 360.0, s, x });
+			edge_case(impl, errors, rgb_distance(impl->hsl_to_rgb(HSL(360.0, s, x)), impl->hsl_to_rgb(HSL(0.0, s, x))) <= t, "hsl hue 360 == hue 0", (double[3]){ 360.0, s, x });
+			edge_case(impl, errors, rgb_distance(impl->hsv_to_rgb(HSV(720.0, s, x)), impl->hsv_to_rgb(HSV(0.0, s, x))) <= t, "hsv hue 720 == hue 0", (double[3]){ 720.0, s, x });
+			edge_case(impl, errors, rgb_distance(impl->hsv_to_rgb(HSV(-360.0, s, x)), impl->hsv_to_rgb(HSV(0.0, s, x))) <= t, "hsv hue -360 == hue 0", (double[3]){ -360.0, s, x });
+			edge_case(impl, errors, rgb_distance(impl->hsv_to_rgb(HSV(360.0, s, x)), reference_hsv_to_rgb(HSV(360.0, s, x))) <= t, "hsv hue 360 matches reference", (double[3]){ 360.0, s, x });
+			edge_case(impl, errors, rgb_distance(impl->hsl_to_rgb(HSL(360.0, s, x)), reference_hsl_to_rgb(HSL(360.0, s, x))) <= t, "hsl hue 360 matches reference", (double[3]){ 360.0, s, x });
+			edge_case(impl, errors, hue_distance(impl->hsv_to_hsl(HSV(360.0, s, x)).h, 0.0) <= ht, "hsv_to_hsl hue 360 == hue 0", (double[3]){ 360.0, s, x });
+			edge_case(impl, errors, hue_distance(impl->hsl_to_hsv(HSL(360.0, s, x)).h, 0.0) <= ht, "hsl_to_hsv hue 360 == hue 0", (double[3]){ 360.0, s, x });
+
+			/* l == 0 and l == 1 take the zero saturation branch */
+			edge_case(impl, errors, rgb_distance(impl->hsl_to_rgb(HSL(h, s, 0.0)), RGB(0.0, 0.0, 0.0)) <= t, "hsl l == 0 is black", (double[3]){ h, s, 0.0 });
+			edge_case(impl, errors, rgb_distance(impl->hsl_to_rgb(HSL(h, s, 1.0)), RGB(1.0, 1.0, 1.0)) <= t, "hsl l == 1 is white", (double[3]){ h, s, 1.0 });
+
+			/* v == 0 gives l == 0 and v == 1, s == 0 gives l == 1, both take the zero saturation branch of hsv_to_hsl */
+			HSL from_black = impl->hsv_to_hsl(HSV(h, s, 0.0));
+			HSL from_white = impl->hsv_to_hsl(HSV(h, 0.0, 1.0));
+			edge_case(impl, errors, fabs(from_black.l) <= t && fabs(from_black.s) <= t, "hsv_to_hsl v == 0 is l == 0 with zero saturation", (double[3]){ h, s, 0.0 });
+			edge_case(impl, errors, fabs(from_white.l - 1.0) <= t && fabs(from_white.s) <= t, "hsv_to_hsl v == 1, s == 0 is l == 1 with zero saturation", (double[3]){ h, 0.0, 1.0 });
+
+			/* l == 1 gives v == 1 and l == 0 gives v == 0, both with zero saturation */
+			HSV to_white = impl->hsl_to_hsv(HSL(h, s, 1.0));
+			HSV to_black = impl->hsl_to_hsv(HSL(h, s, 0.0));
+			edge_case(impl, errors, fabs(to_white.v - 1.0) <= t && fabs(to_white.s) <= t, "hsl_to_hsv l == 1 is v == 1 with zero saturation", (double[3]){ h, s, 1.0 });
+			edge_case(impl, errors, fabs(to_black.v) <= t && fabs(to_black.s) <= t, "hsl_to_hsv l == 0 is v == 0 with zero saturation", (double[3]){ h, s, 0.0 });
+		}
+
+		/* c == 0.0 greys have hue 0 and no saturation */
+		RGB grey = RGB(values[i], values[i], values[i]);
+		HSV hsv = impl->rgb_to_hsv(grey);
+		HSL hsl = impl->rgb_to_hsl(grey);
+		edge_case(impl, errors, hue_distance(hsv.h, 0.0) <= ht && fabs(hsv.s) <= t, "hsv grey has hue 0 and no saturation", (double[3]){ grey.r, grey.g, grey.b });
+		edge_case(impl, errors, hue_distance(hsl.h, 0.0) <= ht && fabs(hsl.s) <= t, "hsl grey has hue 0 and no saturation", (double[3]){ grey.r, grey.g, grey.b });
+		edge_case(impl, errors, rgb_distance(impl->hsv_to_rgb(hsv), grey) <= t, "hsv grey round trip", (double[3]){ grey.r, grey.g, grey.b });
+		edge_case(impl, errors, rgb_distance(impl->hsl_to_rgb(hsl), grey) <= t, "hsl grey round trip", (double[3]){ grey.r, grey.g, grey.b });
+	}
+}
+
+/*
+ * millions of colours per second for each function over every rgb8 colour,
+ * visited in a scrambled order (an odd multiplier is a permutation mod 2^24)
+ * so the hue sector branches aren't predictable from one call to the next
+ */
+#define BENCHMARK(function, expression) do {                   \
+		double sum = 0.0;                                      \
+		double start = now();                                  \
+		for (uint32_t i = 0; i < RGB8_COUNT; i++) {            \
+			RGB c = rgb8((i * 2654435761u) & 0xFFFFFF);        \
+			sum += (expression);                               \
+		}                                                      \
+		result[function] = RGB8_COUNT / (now() - start) * 1e-6; \
+		sink += sum;                                           \
+	} while (0)
+
+void benchmark(const Implementation* impl, double result[FUNCTION_COUNT]) {
+	volatile double sink = 0.0;
+
+	BENCHMARK(FUNCTION_HSV_TO_RGB, impl->hsv_to_rgb(HSV(360.0 * c.r, c.g, c.b)).g);
+	BENCHMARK(FUNCTION_HSL_TO_RGB, impl->hsl_to_rgb(HSL(360.0 * c.r, c.g, c.b)).g);
+	BENCHMARK(FUNCTION_RGB_TO_HSV, impl->rgb_to_hsv(c).h);
+	BENCHMARK(FUNCTION_RGB_TO_HSL, impl->rgb_to_hsl(c).h);
+	BENCHMARK(FUNCTION_HSV_TO_HSL, impl->hsv_to_hsl(HSV(360.0 * c.r, c.g, c.b)).s);
+	BENCHMARK(FUNCTION_HSL_TO_HSV, impl->hsl_to_hsv(HSL(360.0 * c.r, c.g, c.b)).s);
+
+	(void)sink;
+}
+
+int main(int argc, char* argv[]) {
+	long random_count = DEFAULT_RANDOM_COUNT;
+	if (argc > 1) random_count = atol(argv[1]);
+	if (argc > 2 || random_count < 0) {
+		printf("Usage:\n");
+		printf("  %s [number of random samples]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	int failed = 0;
+
+	printf("%-12s %10s %10s %10s %10s %11s %10s %8s %8s %6s\n", "", "error", "tolerance", "hue error", "hue tol",
+	       "round trip", "rt tol", "rgb8", "edge", "");
+	for (size_t i = 0; i < IMPLEMENTATION_COUNT; i++) {
+		const Implementation* impl = &implementations[i];
+		Errors errors = {0};
+
+		check_rgb8(impl, &errors);
+		check_random(impl, &errors, random_count);
+		check_edge_cases(impl, &errors);
+
+		int equivalent = errors.failures == 0 && errors.edge_failures == 0;
+		int roundtrip = errors.roundtrip_failures == 0 && errors.rgb8_mismatches == 0;
+		if (!equivalent || !roundtrip) failed = 1;
+
+		printf("%-12s %10.3e %10.3e %10.3e %10.3e %11.3e %10.3e %8lu %8lu %6s\n", impl->name,
+		       errors.max_error, impl->tolerance, errors.max_hue_error, impl->hue_tolerance,
+		       errors.max_roundtrip_error, impl->roundtrip_tolerance, errors.rgb8_mismatches, errors.edge_failures,
+		       !equivalent ? "FAIL" : !roundtrip ? "FAIL rt" : "ok");
+	}
+
+	printf("\n%-12s", "");
+	for (int f = 0; f < FUNCTION_COUNT; f++) printf(" %11s", function_names[f]);
+	printf("  (Mcolours/s)\n");
+	for (size_t i = 0; i < IMPLEMENTATION_COUNT; i++) {
+		double result[FUNCTION_COUNT];
+		benchmark(&implementations[i], result);
+		printf("%-12s", implementations[i].name);
+		for (int f = 0; f < FUNCTION_COUNT; f++) printf(" %11.1f", result[f]);
+		printf("\n");
+	}
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -4,7 +4,10 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <ctype.h>
+#include <errno.h>
 #include <math.h>
+#include <pthread.h>
+#include <unistd.h>
 
 #define TOO_MANY_COLOURS_IMPLEMENTATION
 #include "too_many_colours.h"
@@ -38,6 +41,34 @@ typedef struct {
 	} data;
 } Colour;
 
+#define HISTOGRAM_DEFAULT_BINS 10
+#define HISTOGRAM_MAX_BINS (1 << 20)
+#define HISTOGRAM_CHUNK_SIZE (1 << 22)
+
+typedef struct {
+	ColourFormat format;
+	int bins;
+	unsigned long long* counts; /* 3 * bins, one row per component */
+	unsigned long long n;
+	unsigned long long achromatic; /* greys, left out of the hue stats and bins */
+	double mean[3];             /* running mean (linear components)       */
+	double m2[3];               /* sum of squared deviations (linear)     */
+	double sin_sum;             /* sum of sin(h) (circular hue, hsv/hsl)  */
+	double cos_sum;             /* sum of cos(h) (circular hue, hsv/hsl)  */
+} Histogram;
+
+typedef struct {
+	pthread_t thread;
+	Histogram histogram;
+	Format input_format;
+	ColourFormat input_colour_format;
+	char** mods;
+	int mod_count;
+	char* begin;
+	char* end;
+	const char* error_line;     /* first line that failed to parse, if any */
+} HistogramWorker;
+
 int log_message(LogPriority priority, const char* fmt, ...) {
 	va_list list;
 	int result;
@@ -121,9 +152,14 @@ int hex_value(char c) {
 	}
 }
 
+int is_hex(const char* string) {
+	while (isspace(*string)) string += 1;
+	return *string == '#' && strlen(string) >= 7;
+}
+
 Colour parse_hex(const char* string) {
 	while (isspace(*string)) string += 1;
-	if (*string != '#' || strlen(string) < 7) {
+	if (!is_hex(string)) {
 		log_message(LOG_ERROR, "expected hex format #RRGGBB\n");
 		exit(EXIT_FAILURE);
 	}
@@ -181,6 +217,31 @@ Colour parse_float(const char* string) {
 	return colour;
 }
 
+Colour parse_colour(Format format, ColourFormat colour_format, const char* string) {
+	Colour colour;
+	if (format == FORMAT_HEX) colour = parse_hex(string);
+	else if (format == FORMAT_INT) colour = parse_int(string);
+	else colour = parse_float(string);
+
+	colour.format = colour_format;
+	if (colour.format == COLOUR_FORMAT_RGB) {
+		colour.data.c[0] /= 255.0;
+		colour.data.c[1] /= 255.0;
+		colour.data.c[2] /= 255.0;
+		clamp_rgb(&colour.data.rgb);
+	} else if (colour.format == COLOUR_FORMAT_HSV) {
+		colour.data.c[1] /= 100.0;
+		colour.data.c[2] /= 100.0;
+		clamp_hsv(&colour.data.hsv);
+	} else if (colour.format == COLOUR_FORMAT_HSL) {
+		colour.data.c[1] /= 100.0;
+		colour.data.c[2] /= 100.0;
+		clamp_hsl(&colour.data.hsl);
+	}
+
+	return colour;
+}
+
 void eval_mod(char* string, Colour* colour) {
 	while (isspace(*string)) string += 1;
 	for (char* s = string; *s != '\0'; s++) *s = tolower(*s);
@@ -288,6 +349,289 @@ void draw_block(FILE* stream, RGB left, RGB right) {
 	}
 }
 
+const char* colour_components(ColourFormat format) {
+	switch (format) {
+		case COLOUR_FORMAT_RGB: return "rgb";
+		case COLOUR_FORMAT_HSV: return "hsv";
+		case COLOUR_FORMAT_HSL: return "hsl";
+		default: return "???";
+	}
+}
+
+/* internal range of a component, colours are stored as [0..360] or [0..1] */
+double component_range(ColourFormat format, int component) {
+	if (format != COLOUR_FORMAT_RGB && component == 0) return 360.0;
+	return 1.0;
+}
+
+/* scale from the internal range to the one used for int and float output */
+double component_scale(ColourFormat format, int component) {
+	if (format == COLOUR_FORMAT_RGB) return 255.0;
+	if (component == 0) return 1.0;
+	return 100.0;
+}
+
+int component_is_circular(ColourFormat format, int component) {
+	return format != COLOUR_FORMAT_RGB && component == 0;
+}
+
+/* hsv/hsl colours without chroma (greys, black and white) have no meaningful hue */
+int is_achromatic(const Colour* colour) {
+	if (colour->format == COLOUR_FORMAT_HSV) return colour->data.hsv.s * colour->data.hsv.v == 0.0;
+	if (colour->format == COLOUR_FORMAT_HSL) return (1.0 - fabs(colour->data.hsl.l*2.0 - 1.0)) * colour->data.hsl.s == 0.0;
+	return 0;
+}
+
+void histogram_init(Histogram* histogram, ColourFormat format, int bins) {
+	memset(histogram, 0, sizeof(*histogram));
+	histogram->format = format;
+	histogram->bins = bins;
+	histogram->counts = calloc(3 * (size_t)bins, sizeof(*histogram->counts));
+	if (histogram->counts == NULL) {
+		log_message(LOG_ERROR, "failed to allocate histogram\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+void histogram_free(Histogram* histogram) {
+	free(histogram->counts);
+	histogram->counts = NULL;
+}
+
+void histogram_add(Histogram* histogram, const Colour* colour) {
+	histogram->n += 1;
+	for (int i = 0; i < 3; i++) {
+		double value = colour->data.c[i];
+		double range = component_range(histogram->format, i);
+		int bin = (int)(value / range * histogram->bins);
+
+		if (component_is_circular(histogram->format, i)) {
+			/* greys get hue 0 from the conversions, counting it would skew the hue towards red */
+			if (is_achromatic(colour)) {
+				histogram->achromatic += 1;
+				continue;
+			}
+			/* wrap() keeps 360 as is, but it's the same hue as 0 */
+			if (bin >= histogram->bins) bin = 0;
+			histogram->sin_sum += sin(value * M_PI / 180.0);
+			histogram->cos_sum += cos(value * M_PI / 180.0);
+		} else {
+			if (bin >= histogram->bins) bin = histogram->bins - 1;
+			double delta = value - histogram->mean[i];
+			histogram->mean[i] += delta / (double)histogram->n;
+			histogram->m2[i] += delta * (value - histogram->mean[i]);
+		}
+		if (bin < 0) bin = 0;
+
+		histogram->counts[i * histogram->bins + bin] += 1;
+	}
+}
+
+void histogram_merge(Histogram* dst, const Histogram* src) {
+	if (src->n == 0) return;
+
+	double n = (double)dst->n + (double)src->n;
+	for (int i = 0; i < 3; i++) {
+		double delta = src->mean[i] - dst->mean[i];
+		dst->mean[i] += delta * (double)src->n / n;
+		dst->m2[i] += src->m2[i] + delta * delta * (double)dst->n * (double)src->n / n;
+	}
+	dst->sin_sum += src->sin_sum;
+	dst->cos_sum += src->cos_sum;
+	dst->n += src->n;
+	dst->achromatic += src->achromatic;
+
+	for (int i = 0; i < 3 * dst->bins; i++) dst->counts[i] += src->counts[i];
+}
+
+void print_histogram(FILE* stream, const Histogram* histogram) {
+	const char* names = colour_components(histogram->format);
+	double n = (double)histogram->n;
+	double chromatic = (double)(histogram->n - histogram->achromatic);
+
+	fprintf(stream, "count %llu\n", histogram->n);
+	if (histogram->format != COLOUR_FORMAT_RGB) fprintf(stream, "achromatic %llu\n", histogram->achromatic);
+	for (int i = 0; i < 3; i++) {
+		double scale = component_scale(histogram->format, i);
+		double mean = 0.0;
+		double variance = 0.0;
+		if (component_is_circular(histogram->format, i)) {
+			/* circular mean hue in degrees, circular variance 1 - |R| in [0..1], over chromatic colours only */
+			if (chromatic > 0.0) {
+				mean = wrap(0.0, 360.0, atan2(histogram->sin_sum, histogram->cos_sum) * 180.0 / M_PI);
+				/* same as the bins, 360 is reported as 0 */
+				if (mean >= 360.0) mean -= 360.0;
+				variance = 1.0 - sqrt(histogram->sin_sum*histogram->sin_sum + histogram->cos_sum*histogram->cos_sum) / chromatic;
+			}
+			fprintf(stream, "%c mean %lf variance %lf circular\n", names[i], scale * mean, variance);
+		} else {
+			if (n > 0.0) {
+				mean = histogram->mean[i];
+				variance = histogram->m2[i] / n;
+			}
+			fprintf(stream, "%c mean %lf variance %lf\n", names[i], scale * mean, scale * scale * variance);
+		}
+	}
+
+	for (int i = 0; i < 3; i++) {
+		double width = component_range(histogram->format, i) * component_scale(histogram->format, i) / histogram->bins;
+		for (int bin = 0; bin < histogram->bins; bin++) {
+			fprintf(stream, "%c %lf %lf %llu\n", names[i], width * bin, width * (bin + 1), histogram->counts[i * histogram->bins + bin]);
+		}
+	}
+}
+
+void* histogram_worker(void* data) {
+	HistogramWorker* worker = data;
+	char* line = worker->begin;
+
+	while (line < worker->end) {
+		char* next = memchr(line, '\n', worker->end - line);
+		if (next == NULL) next = worker->end;
+		*next = '\0';
+
+		char* s = line;
+		while (isspace(*s)) s += 1;
+		if (*s != '\0') {
+			/* parse_hex() exits on errors, which isn't safe from several threads at once */
+			if (worker->input_format == FORMAT_HEX && !is_hex(s)) {
+				worker->error_line = s;
+				return NULL;
+			}
+
+			Colour in = parse_colour(worker->input_format, worker->input_colour_format, s);
+			Colour out;
+			convert(worker->histogram.format, &in, &out);
+			for (int i = 0; i < worker->mod_count; i++) eval_mod(worker->mods[i], &out);
+			histogram_add(&worker->histogram, &out);
+		}
+
+		line = next + 1;
+	}
+
+	return NULL;
+}
+
+/*
+ * streams the input in chunks cut at line boundaries, every chunk is split
+ * between the workers which each accumulate into their own histogram, the
+ * histograms are merged once the whole input has been read
+ */
+int histogram(FILE* input_file, FILE* output_file, Format input_format, ColourFormat input_colour_format,
+              ColourFormat output_colour_format, int bins, int threads, char** mods, int mod_count) {
+	char* buffer = malloc(HISTOGRAM_CHUNK_SIZE + 1);
+	HistogramWorker* workers = calloc(threads, sizeof(*workers));
+	if (buffer == NULL || workers == NULL) {
+		log_message(LOG_ERROR, "failed to allocate histogram buffers\n");
+		return EXIT_FAILURE;
+	}
+
+	/* eval_mod() exits on errors, so check every mod once here instead of in the workers */
+	for (int i = 0; i < mod_count; i++) {
+		char* mod = strdup(mods[i]);
+		if (mod == NULL) {
+			log_message(LOG_ERROR, "failed to allocate histogram buffers\n");
+			return EXIT_FAILURE;
+		}
+		Colour dummy;
+		memset(&dummy, 0, sizeof(dummy));
+		dummy.format = output_colour_format;
+		eval_mod(mod, &dummy);
+		free(mod);
+	}
+
+	for (int t = 0; t < threads; t++) {
+		workers[t].input_format = input_format;
+		workers[t].input_colour_format = input_colour_format;
+		workers[t].mod_count = mod_count;
+		/* eval_mod() lowercases in place, so each worker gets its own copies */
+		workers[t].mods = calloc(mod_count + 1, sizeof(char*));
+		if (workers[t].mods == NULL) {
+			log_message(LOG_ERROR, "failed to allocate histogram buffers\n");
+			return EXIT_FAILURE;
+		}
+		for (int i = 0; i < mod_count; i++) {
+			workers[t].mods[i] = strdup(mods[i]);
+			if (workers[t].mods[i] == NULL) {
+				log_message(LOG_ERROR, "failed to allocate histogram buffers\n");
+				return EXIT_FAILURE;
+			}
+		}
+		histogram_init(&workers[t].histogram, output_colour_format, bins);
+	}
+
+	size_t carry = 0;
+	for (;;) {
+		size_t size = carry + fread(buffer + carry, 1, HISTOGRAM_CHUNK_SIZE - carry, input_file);
+		if (ferror(input_file)) {
+			log_message(LOG_ERROR, "failed to read input: %s\n", strerror(errno));
+			return EXIT_FAILURE;
+		}
+		int eof = size < HISTOGRAM_CHUNK_SIZE;
+		if (size == 0) break;
+
+		/* the last line of the input may not end in a newline */
+		size_t end = size;
+		if (eof) buffer[end] = '\0';
+		else {
+			while (end > 0 && buffer[end - 1] != '\n') end -= 1;
+			if (end == 0) {
+				log_message(LOG_ERROR, "line longer than %d bytes\n", HISTOGRAM_CHUNK_SIZE);
+				return EXIT_FAILURE;
+			}
+		}
+
+		size_t begin = 0;
+		for (int t = 0; t < threads; t++) {
+			size_t split = end * (t + 1) / threads;
+			if (split < begin) split = begin;
+			while (split < end && buffer[split] != '\n') split += 1;
+			if (split < end) split += 1;
+
+			workers[t].begin = buffer + begin;
+			workers[t].end = buffer + split;
+			begin = split;
+		}
+
+		if (threads == 1) histogram_worker(&workers[0]);
+		else {
+			int started = 0;
+			while (started < threads && pthread_create(&workers[started].thread, NULL, histogram_worker, &workers[started]) == 0)
+				started += 1;
+			for (int t = 0; t < started; t++) pthread_join(workers[t].thread, NULL);
+			if (started < threads) {
+				log_message(LOG_ERROR, "failed to start histogram thread\n");
+				return EXIT_FAILURE;
+			}
+		}
+
+		for (int t = 0; t < threads; t++) {
+			if (workers[t].error_line != NULL) {
+				log_message(LOG_ERROR, "expected hex format #RRGGBB, got '%s'\n", workers[t].error_line);
+				return EXIT_FAILURE;
+			}
+		}
+
+		carry = size - end;
+		memmove(buffer, buffer + end, carry);
+		if (eof) break;
+	}
+
+	for (int t = 1; t < threads; t++) histogram_merge(&workers[0].histogram, &workers[t].histogram);
+	if (workers[0].histogram.n == 0) log_message(LOG_WARNING, "no colours were read\n");
+	print_histogram(output_file, &workers[0].histogram);
+
+	for (int t = 0; t < threads; t++) {
+		for (int i = 0; i < mod_count; i++) free(workers[t].mods[i]);
+		free(workers[t].mods);
+		histogram_free(&workers[t].histogram);
+	}
+	free(workers);
+	free(buffer);
+
+	return EXIT_SUCCESS;
+}
+
 void usage(const char* program) {
 	printf("Usage:\n");
 	printf("  %s [options]\n", program);
@@ -301,6 +645,9 @@ void usage(const char* program) {
 	printf("  -o <file>            output file\n");
 	printf("  -b                   draws a coloured block with ansi escape codes\n");
 	printf("  -m                   '<colour format>:<colour component>[=|+|-][num|%%]' modify different aspects of a colour\n");
+	printf("  --histogram          reads every line and prints mean, variance and a histogram per output colour component\n");
+	printf("  --bins <num>         number of histogram bins per component (default %d)\n", HISTOGRAM_DEFAULT_BINS);
+	printf("  -j <num>             number of histogram threads (default: number of cpus)\n");
 	printf("\n");
 }
 
@@ -314,6 +661,16 @@ int main(int argc, char* argv[]) {
 	FILE* input_file = stdin;
 	FILE* output_file = stdout;
 	int block = 0;
+	int histogram_mode = 0;
+	int bins = 0;
+	int threads = 0;
+	char** mods = calloc(argc, sizeof(char*));
+	int mod_count = 0;
+
+	if (mods == NULL) {
+		log_message(LOG_ERROR, "failed to allocate mods\n");
+		return EXIT_FAILURE;
+	}
 
 	Colour in;
 	Colour out;
@@ -327,6 +684,26 @@ int main(int argc, char* argv[]) {
 		if (strncmp(argv[i], "-h", 2) == 0 || strncmp(argv[i], "--help", 6) == 0) {
 			usage(argv[0]);
 			return EXIT_SUCCESS;
+		} else if (strncmp(argv[i], "--histogram", 11) == 0) {
+			histogram_mode = 1;
+		} else if (strncmp(argv[i], "--bins", 6) == 0) {
+			if (argv[i][6] == '\0' && i < argc-1) value = argv[++i];
+			else value = argv[i]+6;
+
+			bins = atoi(value);
+			if (bins <= 0 || bins > HISTOGRAM_MAX_BINS) {
+				log_message(LOG_ERROR, "number of bins must be between 1 and %d\n", HISTOGRAM_MAX_BINS);
+				return EXIT_FAILURE;
+			}
+		} else if (strncmp(argv[i], "-j", 2) == 0) {
+			if (argv[i][2] == '\0' && i < argc-1) value = argv[++i];
+			else value = argv[i]+2;
+
+			threads = atoi(value);
+			if (threads <= 0) {
+				log_message(LOG_ERROR, "number of threads must be positive\n");
+				return EXIT_FAILURE;
+			}
 		} else if (strncmp(argv[i], "-ic", 3) == 0) {
 			if (argv[i][3] == '\0' && i < argc-1) value = argv[++i];
 			else value = argv[i]+3;
@@ -378,6 +755,8 @@ int main(int argc, char* argv[]) {
 		} else if (strncmp(argv[i], "-m", 2) == 0) {
 			if (argv[i][2] == '\0' && i < argc-1) value = argv[++i];
 			else value = argv[i]+2;
+
+			mods[mod_count++] = value;
 		} else {
 			log_message(LOG_ERROR, "unrecognised option '%s'\n", argv[i]);
 			return EXIT_FAILURE;
@@ -389,6 +768,9 @@ int main(int argc, char* argv[]) {
 		return EXIT_FAILURE;
 	}
 
+	if (!histogram_mode && (bins != 0 || threads != 0))
+		log_message(LOG_WARNING, "--bins and -j are ignored without --histogram\n");
+
 	if (output_colour_format == COLOUR_FORMAT_NONE) output_colour_format = input_colour_format;
 	if (output_format == FORMAT_NONE) output_format = input_format;
 
@@ -397,7 +779,7 @@ int main(int argc, char* argv[]) {
 		return EXIT_FAILURE;
 	}
 
-	if (output_format == FORMAT_HEX && output_colour_format != COLOUR_FORMAT_RGB) {
+	if (!histogram_mode && output_format == FORMAT_HEX && output_colour_format != COLOUR_FORMAT_RGB) {
 		log_message(LOG_ERROR, "hex colour format only supported for rgb\n");
 		return EXIT_FAILURE;
 	}
@@ -410,48 +792,32 @@ int main(int argc, char* argv[]) {
 		}
 	}
 
-	getline(&line, &len, input_file);
-	if (input_format == FORMAT_HEX) in = parse_hex(line);
-	else if (input_format == FORMAT_INT) in = parse_int(line);
-	else if (input_format == FORMAT_FLOAT) in = parse_float(line);
-
-	in.format = input_colour_format;
-	if (in.format == COLOUR_FORMAT_RGB) {
-		in.data.c[0] /= 255.0;
-		in.data.c[1] /= 255.0;
-		in.data.c[2] /= 255.0;
-		clamp_rgb(&in.data.rgb);
-	} else if (in.format == COLOUR_FORMAT_HSV) {
-		in.data.c[1] /= 100.0;
-		in.data.c[2] /= 100.0;
-		clamp_hsv(&in.data.hsv);
-	} else if (in.format == COLOUR_FORMAT_HSL) {
-		in.data.c[1] /= 100.0;
-		in.data.c[2] /= 100.0;
-		clamp_hsl(&in.data.hsl);
-	}
-
-	convert(output_colour_format, &in, &out);
-
-	for (int i = 1; i < argc; i++) {
-		char* value = NULL;
-
-		if (strncmp(argv[i], "-m", 2) == 0) {
-			if (argv[i][2] == '\0' && i < argc-1) value = argv[++i];
-			else value = argv[i]+2;
-
-			eval_mod(value, &out);
-		}
-	}
-
 	if (output_path != NULL) {
-		output_file = fopen(output_path, "r");
+		output_file = fopen(output_path, "w");
 		if (output_file == NULL) {
 			log_message(LOG_ERROR, "failed to open '%s'\n", output_path);
 			return EXIT_FAILURE;
 		}
 	}
 
+	if (histogram_mode) {
+		if (bins == 0) bins = HISTOGRAM_DEFAULT_BINS;
+		if (threads == 0) threads = MAX(1, (int)sysconf(_SC_NPROCESSORS_ONLN));
+		int result = histogram(input_file, output_file, input_format, input_colour_format,
+		                       output_colour_format, bins, threads, mods, mod_count);
+		if (input_file != stdin) fclose(input_file);
+		if (output_file != stdout) fclose(output_file);
+		free(mods);
+		return result;
+	}
+
+	getline(&line, &len, input_file);
+	in = parse_colour(input_format, input_colour_format, line);
+
+	convert(output_colour_format, &in, &out);
+
+	for (int i = 0; i < mod_count; i++) eval_mod(mods[i], &out);
+
 	if (output_format == FORMAT_HEX) {
 		if (out.format == COLOUR_FORMAT_RGB)
 			fprintf(output_file, "#%02X%02X%02X\n", (int)round(255.0 * out.data.rgb.r), (int)round(255.0 * out.data.rgb.g), (int)round(255.0 * out.data.rgb.b));
@@ -481,6 +847,7 @@ int main(int argc, char* argv[]) {
 
 	if (input_file != stdin) fclose(input_file);
 	if (output_file != stdout) fclose(output_file);
+	free(mods);
 
 	return EXIT_SUCCESS;
 }